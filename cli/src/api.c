@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <curl/curl.h>
 #include <json-c/json.h>
 #include "api.h"
@@ -28,6 +29,19 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return realsize;
 }
 
+static struct curl_slist *build_headers(Config *config, const char *content_type) {
+    struct curl_slist *headers = NULL;
+    char content_type_header[64];
+    char auth_header[MAX_API_KEY_LENGTH + 20];
+    
+    snprintf(content_type_header, sizeof(content_type_header), "Content-Type: %s", content_type);
+    snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", config->api_key);
+    
+    headers = curl_slist_append(headers, content_type_header);
+    headers = curl_slist_append(headers, auth_header);
+    return headers;
+}
+
 static int perform_request(Config *config, const char *url, const char *method, 
                           const char *post_data, struct MemoryStruct *chunk) {
     CURL *curl;
@@ -43,11 +57,7 @@ static int perform_request(Config *config, const char *url, const char *method,
     chunk->memory = malloc(1);
     chunk->size = 0;
     
-    char auth_header[MAX_API_KEY_LENGTH + 20];
-    snprintf(auth_header, sizeof(auth_header), "x-api-key: %s", config->api_key);
-    
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, auth_header);
+    headers = build_headers(config, "application/json");
     
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
@@ -79,10 +89,95 @@ static int perform_request(Config *config, const char *url, const char *method,
     return 1;
 }
 
-int api_get_passwords(Config *config, Password **passwords, int *count) {
+// Tags travel as a comma-separated list in Password.tags
+static void parse_tags(json_object *tags_obj, char *out, size_t size) {
+    out[0] = '\0';
+    
+    if (!tags_obj || !json_object_is_type(tags_obj, json_type_array)) {
+        return;
+    }
+    
+    size_t len = 0;
+    int tag_count = json_object_array_length(tags_obj);
+    
+    for (int i = 0; i < tag_count; i++) {
+        const char *tag = json_object_get_string(json_object_array_get_idx(tags_obj, i));
+        int written = snprintf(out + len, size - len, "%s%s", i > 0 ? "," : "", tag);
+        
+        // Never keep half a tag; it would be saved back as a different one
+        if (written < 0 || (size_t)written >= size - len) {
+            out[len] = '\0';
+            break;
+        }
+        
+        len += written;
+    }
+}
+
+static json_object *build_tags(const char *tags) {
+    json_object *array = json_object_new_array();
+    char buffer[MAX_TAGS_LENGTH];
+    
+    strncpy(buffer, tags, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    
+    for (char *tag = strtok(buffer, ","); tag; tag = strtok(NULL, ",")) {
+        while (*tag == ' ') {
+            tag++;
+        }
+        
+        char *end = tag + strlen(tag);
+        while (end > tag && end[-1] == ' ') {
+            *--end = '\0';
+        }
+        
+        if (strlen(tag) > 0) {
+            json_object_array_add(array, json_object_new_string(tag));
+        }
+    }
+    
+    return array;
+}
+
+// Appends ?tag=a&tag=b for a tag filter; fails if the URL would not fit
+static int build_tag_url(Config *config, const char *path, char **tags, int tag_count, 
+                         char *url, size_t size) {
+    size_t len = snprintf(url, size, "%s%s", config->server_url, path);
+    
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        fprintf(stderr, "Failed to initialize curl\n");
+        return 0;
+    }
+    
+    for (int i = 0; i < tag_count; i++) {
+        char *escaped = curl_easy_escape(curl, tags[i], 0);
+        if (!escaped) {
+            curl_easy_cleanup(curl);
+            return 0;
+        }
+        
+        len += snprintf(url + len, size - len, "%ctag=%s", i == 0 ? '?' : '&', escaped);
+        curl_free(escaped);
+        
+        if (len >= size) {
+            fprintf(stderr, "Too many tags in filter\n");
+            curl_easy_cleanup(curl);
+            return 0;
+        }
+    }
+    
+    curl_easy_cleanup(curl);
+    return 1;
+}
+
+int api_get_passwords(Config *config, char **tags, int tag_count, Password **passwords, int *count) {
     struct MemoryStruct chunk;
-    char url[MAX_URL_LENGTH + 20];
-    snprintf(url, sizeof(url), "%s/passwords", config->server_url);
+    char url[MAX_URL_LENGTH + 2048];
+    
+    if (!build_tag_url(config, "/passwords", tags, tag_count, url, sizeof(url))) {
+        return 0;
+    }
     
     if (!perform_request(config, url, "GET", NULL, &chunk)) {
         return 0;
@@ -118,6 +213,7 @@ int api_get_passwords(Config *config, Password **passwords, int *count) {
     for (int i = 0; i < array_len; i++) {
         json_object *item = json_object_array_get_idx(data_obj, i);
         json_object *id_obj, *title_obj, *username_obj, *password_obj, *url_obj, *notes_obj;
+        json_object *tags_obj = NULL;
         
         json_object_object_get_ex(item, "id", &id_obj);
         json_object_object_get_ex(item, "title", &title_obj);
@@ -125,6 +221,7 @@ int api_get_passwords(Config *config, Password **passwords, int *count) {
         json_object_object_get_ex(item, "password", &password_obj);
         json_object_object_get_ex(item, "url", &url_obj);
         json_object_object_get_ex(item, "notes", &notes_obj);
+        json_object_object_get_ex(item, "tags", &tags_obj);
         
         (*passwords)[i].id = json_object_get_int(id_obj);
         strncpy((*passwords)[i].title, json_object_get_string(title_obj), 255);
@@ -142,6 +239,8 @@ int api_get_passwords(Config *config, Password **passwords, int *count) {
         } else {
             (*passwords)[i].notes[0] = '\0';
         }
+        
+        parse_tags(tags_obj, (*passwords)[i].tags, sizeof((*passwords)[i].tags));
     }
     
     json_object_put(root);
@@ -182,6 +281,7 @@ int api_get_password(Config *config, int id, Password *password) {
     }
     
     json_object *id_obj, *title_obj, *username_obj, *password_obj, *url_obj, *notes_obj;
+    json_object *tags_obj = NULL;
     
     json_object_object_get_ex(data_obj, "id", &id_obj);
     json_object_object_get_ex(data_obj, "title", &title_obj);
@@ -189,6 +289,7 @@ int api_get_password(Config *config, int id, Password *password) {
     json_object_object_get_ex(data_obj, "password", &password_obj);
     json_object_object_get_ex(data_obj, "url", &url_obj);
     json_object_object_get_ex(data_obj, "notes", &notes_obj);
+    json_object_object_get_ex(data_obj, "tags", &tags_obj);
     
     password->id = json_object_get_int(id_obj);
     strncpy(password->title, json_object_get_string(title_obj), 255);
@@ -207,6 +308,8 @@ int api_get_password(Config *config, int id, Password *password) {
         password->notes[0] = '\0';
     }
     
+    parse_tags(tags_obj, password->tags, sizeof(password->tags));
+    
     json_object_put(root);
     free(chunk.memory);
     return 1;
@@ -230,6 +333,8 @@ int api_add_password(Config *config, Password *password) {
         json_object_object_add(json, "notes", json_object_new_string(password->notes));
     }
     
+    json_object_object_add(json, "tags", build_tags(password->tags));
+    
     const char *json_str = json_object_to_json_string(json);
     
     int result = perform_request(config, url, "POST", json_str, &chunk);
@@ -284,6 +389,8 @@ int api_update_password(Config *config, Password *password) {
         json_object_object_add(json, "notes", json_object_new_string(password->notes));
     }
     
+    json_object_object_add(json, "tags", build_tags(password->tags));
+    
     const char *json_str = json_object_to_json_string(json);
     
     int result = perform_request(config, url, "PUT", json_str, &chunk);
@@ -344,3 +451,366 @@ int api_delete_password(Config *config, int id) {
     free(chunk.memory);
     return 1;
 }
+
+int api_get_history(Config *config, int id, PasswordVersion **versions, int *count) {
+    struct MemoryStruct chunk;
+    char url[MAX_URL_LENGTH + 40];
+    snprintf(url, sizeof(url), "%s/passwords/%d/history", config->server_url, id);
+    
+    if (!perform_request(config, url, "GET", NULL, &chunk)) {
+        return 0;
+    }
+    
+    json_object *root = json_tokener_parse(chunk.memory);
+    if (!root) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *success_obj, *data_obj;
+    if (!json_object_object_get_ex(root, "success", &success_obj) || 
+        !json_object_get_boolean(success_obj)) {
+        fprintf(stderr, "API request failed\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    if (!json_object_object_get_ex(root, "data", &data_obj)) {
+        fprintf(stderr, "No data in response\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    int array_len = json_object_array_length(data_obj);
+    *count = array_len;
+    *versions = (PasswordVersion *)calloc(array_len > 0 ? array_len : 1, sizeof(PasswordVersion));
+    
+    for (int i = 0; i < array_len; i++) {
+        json_object *item = json_object_array_get_idx(data_obj, i);
+        json_object *version_obj, *created_obj, *title_obj, *username_obj, *password_obj;
+        json_object *url_obj = NULL, *notes_obj = NULL, *tags_obj = NULL, *deleted_obj = NULL;
+        PasswordVersion *version = &(*versions)[i];
+        
+        json_object_object_get_ex(item, "version", &version_obj);
+        json_object_object_get_ex(item, "created_at", &created_obj);
+        json_object_object_get_ex(item, "title", &title_obj);
+        json_object_object_get_ex(item, "username", &username_obj);
+        json_object_object_get_ex(item, "password", &password_obj);
+        json_object_object_get_ex(item, "url", &url_obj);
+        json_object_object_get_ex(item, "notes", &notes_obj);
+        json_object_object_get_ex(item, "tags", &tags_obj);
+        json_object_object_get_ex(item, "deleted", &deleted_obj);
+        
+        version->version = json_object_get_int(version_obj);
+        version->deleted = deleted_obj && json_object_get_boolean(deleted_obj);
+        version->entry.id = id;
+        strncpy(version->created_at, json_object_get_string(created_obj), 31);
+        strncpy(version->entry.title, json_object_get_string(title_obj), 255);
+        strncpy(version->entry.username, json_object_get_string(username_obj), 255);
+        strncpy(version->entry.password, json_object_get_string(password_obj), 1023);
+        
+        if (url_obj && !json_object_is_type(url_obj, json_type_null)) {
+            strncpy(version->entry.url, json_object_get_string(url_obj), 511);
+        }
+        
+        if (notes_obj && !json_object_is_type(notes_obj, json_type_null)) {
+            strncpy(version->entry.notes, json_object_get_string(notes_obj), 2047);
+        }
+        
+        parse_tags(tags_obj, version->entry.tags, sizeof(version->entry.tags));
+    }
+    
+    json_object_put(root);
+    free(chunk.memory);
+    return 1;
+}
+
+int api_rollback_password(Config *config, int id, int version, int *new_version) {
+    struct MemoryStruct chunk;
+    char url[MAX_URL_LENGTH + 40];
+    snprintf(url, sizeof(url), "%s/passwords/%d/rollback", config->server_url, id);
+    
+    json_object *json = json_object_new_object();
+    json_object_object_add(json, "version", json_object_new_int(version));
+    
+    const char *json_str = json_object_to_json_string(json);
+    
+    int result = perform_request(config, url, "POST", json_str, &chunk);
+    
+    json_object_put(json);
+    
+    if (!result) {
+        return 0;
+    }
+    
+    json_object *root = json_tokener_parse(chunk.memory);
+    if (!root) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *success_obj, *data_obj, *version_obj;
+    if (!json_object_object_get_ex(root, "success", &success_obj) || 
+        !json_object_get_boolean(success_obj)) {
+        fprintf(stderr, "API request failed\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    if (json_object_object_get_ex(root, "data", &data_obj) &&
+        json_object_object_get_ex(data_obj, "version", &version_obj)) {
+        *new_version = json_object_get_int(version_obj);
+    }
+    
+    json_object_put(root);
+    free(chunk.memory);
+    return 1;
+}
+
+int api_rotate_passwords(Config *config, Rotation *rotations, int count) {
+    struct MemoryStruct chunk;
+    char url[MAX_URL_LENGTH + 30];
+    snprintf(url, sizeof(url), "%s/passwords/rotate", config->server_url);
+    
+    json_object *json = json_object_new_object();
+    json_object *updates = json_object_new_array();
+    
+    for (int i = 0; i < count; i++) {
+        json_object *update = json_object_new_object();
+        json_object_object_add(update, "id", json_object_new_int(rotations[i].id));
+        json_object_object_add(update, "password", json_object_new_string(rotations[i].password));
+        json_object_array_add(updates, update);
+    }
+    
+    json_object_object_add(json, "updates", updates);
+    
+    const char *json_str = json_object_to_json_string(json);
+    
+    int result = perform_request(config, url, "POST", json_str, &chunk);
+    
+    json_object_put(json);
+    
+    if (!result) {
+        return 0;
+    }
+    
+    json_object *root = json_tokener_parse(chunk.memory);
+    if (!root) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *success_obj, *data_obj, *error_obj;
+    if (!json_object_object_get_ex(root, "success", &success_obj) || 
+        !json_object_get_boolean(success_obj)) {
+        if (json_object_object_get_ex(root, "error", &error_obj)) {
+            fprintf(stderr, "API request failed: %s\n", json_object_get_string(error_obj));
+        } else {
+            fprintf(stderr, "API request failed\n");
+        }
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    if (!json_object_object_get_ex(root, "data", &data_obj) ||
+        (int)json_object_array_length(data_obj) != count) {
+        fprintf(stderr, "Unexpected rotation response\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    // Results come back in request order
+    for (int i = 0; i < count; i++) {
+        json_object *item = json_object_array_get_idx(data_obj, i);
+        json_object *old_obj, *new_obj;
+        
+        json_object_object_get_ex(item, "old_version", &old_obj);
+        json_object_object_get_ex(item, "new_version", &new_obj);
+        
+        rotations[i].old_version = json_object_get_int(old_obj);
+        rotations[i].new_version = json_object_get_int(new_obj);
+    }
+    
+    json_object_put(root);
+    free(chunk.memory);
+    return 1;
+}
+
+// Streams the compressed snapshot straight to disk so memory use stays flat
+// regardless of vault size. The file only appears once the download is whole.
+int api_download_snapshot(Config *config, const char *path) {
+    char url[MAX_URL_LENGTH + 30];
+    char part_path[4096];
+    snprintf(url, sizeof(url), "%s/admin/snapshot", config->server_url);
+    snprintf(part_path, sizeof(part_path), "%s.part", path);
+    
+    FILE *file = fopen(part_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for writing\n", part_path);
+        return 0;
+    }
+    
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        fprintf(stderr, "Failed to initialize curl\n");
+        fclose(file);
+        remove(part_path);
+        return 0;
+    }
+    
+    struct curl_slist *headers = build_headers(config, "application/json");
+    
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)file);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    
+    CURLcode res = curl_easy_perform(curl);
+    
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    
+    if (fclose(file) != 0 || res != CURLE_OK) {
+        if (res != CURLE_OK) {
+            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        }
+        remove(part_path);
+        return 0;
+    }
+    
+    if (rename(part_path, path) != 0) {
+        fprintf(stderr, "Failed to move snapshot to %s\n", path);
+        remove(part_path);
+        return 0;
+    }
+    
+    return 1;
+}
+
+int api_restore_snapshot(Config *config, const char *path) {
+    struct MemoryStruct chunk;
+    struct stat st;
+    char url[MAX_URL_LENGTH + 30];
+    snprintf(url, sizeof(url), "%s/admin/restore", config->server_url);
+    
+    FILE *file = fopen(path, "rb");
+    if (!file || fstat(fileno(file), &st) != 0) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        if (file) {
+            fclose(file);
+        }
+        return 0;
+    }
+    
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        fprintf(stderr, "Failed to initialize curl\n");
+        fclose(file);
+        return 0;
+    }
+    
+    chunk.memory = malloc(1);
+    chunk.size = 0;
+    
+    struct curl_slist *headers = build_headers(config, "application/gzip");
+    
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_READDATA, (void *)file);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)st.st_size);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+    
+    CURLcode res = curl_easy_perform(curl);
+    
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    fclose(file);
+    
+    if (res != CURLE_OK) {
+        fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *root = json_tokener_parse(chunk.memory);
+    if (!root) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *success_obj, *error_obj;
+    if (!json_object_object_get_ex(root, "success", &success_obj) || 
+        !json_object_get_boolean(success_obj)) {
+        if (json_object_object_get_ex(root, "error", &error_obj)) {
+            fprintf(stderr, "API request failed: %s\n", json_object_get_string(error_obj));
+        } else {
+            fprintf(stderr, "API request failed\n");
+        }
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object_put(root);
+    free(chunk.memory);
+    return 1;
+}
+
+int api_get_password_ids(Config *config, char **tags, int tag_count, int **ids, int *count) {
+    struct MemoryStruct chunk;
+    char url[MAX_URL_LENGTH + 2048];
+    
+    if (!build_tag_url(config, "/passwords/ids", tags, tag_count, url, sizeof(url))) {
+        return 0;
+    }
+    
+    if (!perform_request(config, url, "GET", NULL, &chunk)) {
+        return 0;
+    }
+    
+    json_object *root = json_tokener_parse(chunk.memory);
+    if (!root) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        free(chunk.memory);
+        return 0;
+    }
+    
+    json_object *success_obj, *data_obj;
+    if (!json_object_object_get_ex(root, "success", &success_obj) || 
+        !json_object_get_boolean(success_obj)) {
+        fprintf(stderr, "API request failed\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    if (!json_object_object_get_ex(root, "data", &data_obj)) {
+        fprintf(stderr, "No data in response\n");
+        json_object_put(root);
+        free(chunk.memory);
+        return 0;
+    }
+    
+    int array_len = json_object_array_length(data_obj);
+    *count = array_len;
+    *ids = (int *)malloc(sizeof(int) * (array_len > 0 ? array_len : 1));
+    
+    for (int i = 0; i < array_len; i++) {
+        (*ids)[i] = json_object_get_int(json_object_array_get_idx(data_obj, i));
+    }
+    
+    json_object_put(root);
+    free(chunk.memory);
+    return 1;
+}
@@ -3,6 +3,9 @@
 
 #include "config.h"
 
+// Comma-separated tags; the server allows at most 16 tags of 64 bytes each
+#define MAX_TAGS_LENGTH (16 * 65)
+
 typedef struct {
     int id;
     char title[256];
@@ -10,12 +13,33 @@ typedef struct {
     char password[1024];
     char url[512];
     char notes[2048];
+    char tags[MAX_TAGS_LENGTH];
 } Password;
 
-int api_get_passwords(Config *config, Password **passwords, int *count);
+typedef struct {
+    int version;
+    int deleted;
+    char created_at[32];
+    Password entry;
+} PasswordVersion;
+
+typedef struct {
+    int id;
+    char password[1024];
+    int old_version;
+    int new_version;
+} Rotation;
+
+int api_get_passwords(Config *config, char **tags, int tag_count, Password **passwords, int *count);
+int api_get_password_ids(Config *config, char **tags, int tag_count, int **ids, int *count);
 int api_get_password(Config *config, int id, Password *password);
 int api_add_password(Config *config, Password *password);
 int api_update_password(Config *config, Password *password);
 int api_delete_password(Config *config, int id);
+int api_get_history(Config *config, int id, PasswordVersion **versions, int *count);
+int api_rollback_password(Config *config, int id, int version, int *new_version);
+int api_rotate_passwords(Config *config, Rotation *rotations, int count);
+int api_download_snapshot(Config *config, const char *path);
+int api_restore_snapshot(Config *config, const char *path);
 
 #endif
@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
 #include <termios.h>
 #include "commands.h"
 #include "api.h"
+#include "generate.h"
 
 static char* get_password(const char *prompt) {
     static char password[1024];
@@ -60,20 +62,32 @@ int cmd_configure(Config *config, int argc, char **argv) {
 int cmd_list(Config *config, int argc, char **argv) {
     Password *passwords;
     int count;
+    char *tags[argc];
+    int tag_count = 0;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--tag") == 0 && i + 1 < argc) {
+            tags[tag_count++] = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: vault list [--tag <tag>]...\n");
+            return 0;
+        }
+    }
     
-    if (!api_get_passwords(config, &passwords, &count)) {
+    if (!api_get_passwords(config, tags, tag_count, &passwords, &count)) {
         fprintf(stderr, "Failed to retrieve passwords.\n");
         return 0;
     }
     
-    printf("ID  | Title                 | Username               \n");
-    printf("----+-----------------------+-----------------------\n");
+    printf("ID  | Title                 | Username              | Tags\n");
+    printf("----+-----------------------+-----------------------+-----------------------\n");
     
     for (int i = 0; i < count; i++) {
-        printf("%-3d | %-21s | %-21s\n", 
+        printf("%-3d | %-21s | %-21s | %s\n", 
                passwords[i].id, 
                passwords[i].title, 
-               passwords[i].username);
+               passwords[i].username,
+               passwords[i].tags);
     }
     
     free(passwords);
@@ -106,6 +120,10 @@ int cmd_get(Config *config, int argc, char **argv) {
         printf("Notes: %s\n", password.notes);
     }
     
+    if (strlen(password.tags) > 0) {
+        printf("Tags: %s\n", password.tags);
+    }
+    
     return 1;
 }
 
@@ -135,6 +153,12 @@ int cmd_add(Config *config, int argc, char **argv) {
     input[strcspn(input, "\n")] = 0;
     strncpy(password.notes, input, 2047);
     
+    printf("Tags (comma-separated, optional): ");
+    fgets(input, sizeof(input), stdin);
+    input[strcspn(input, "\n")] = 0;
+    strncpy(password.tags, input, MAX_TAGS_LENGTH - 1);
+    password.tags[MAX_TAGS_LENGTH - 1] = '\0';
+    
     if (api_add_password(config, &password)) {
         printf("Password added successfully with ID: %d\n", password.id);
         return 1;
@@ -194,6 +218,16 @@ int cmd_update(Config *config, int argc, char **argv) {
         strncpy(password.notes, input, 2047);
     }
     
+    printf("Tags [%s] (- to clear): ", password.tags);
+    fgets(input, sizeof(input), stdin);
+    input[strcspn(input, "\n")] = 0;
+    if (strcmp(input, "-") == 0) {
+        password.tags[0] = '\0';
+    } else if (strlen(input) > 0) {
+        strncpy(password.tags, input, MAX_TAGS_LENGTH - 1);
+        password.tags[MAX_TAGS_LENGTH - 1] = '\0';
+    }
+    
     if (api_update_password(config, &password)) {
         printf("Password updated successfully.\n");
         return 1;
@@ -229,14 +263,256 @@ int cmd_delete(Config *config, int argc, char **argv) {
     }
 }
 
+int cmd_history(Config *config, int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: vault history <id>\n");
+        return 0;
+    }
+    
+    int id = atoi(argv[2]);
+    PasswordVersion *versions;
+    int count;
+    
+    if (!api_get_history(config, id, &versions, &count)) {
+        fprintf(stderr, "Failed to retrieve password history.\n");
+        return 0;
+    }
+    
+    printf("Ver | Saved               | Title                 | Username              | Tags\n");
+    printf("----+---------------------+-----------------------+-----------------------+-----------------------\n");
+    
+    for (int i = 0; i < count; i++) {
+        printf("%-3d | %-19s | %-21s | %-21s | %s\n", 
+               versions[i].version, 
+               versions[i].created_at, 
+               versions[i].deleted ? "(deleted)" : versions[i].entry.title, 
+               versions[i].entry.username,
+               versions[i].entry.tags);
+    }
+    
+    free(versions);
+    return 1;
+}
+
+int cmd_rollback(Config *config, int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: vault rollback <id> <version>\n");
+        return 0;
+    }
+    
+    int id = atoi(argv[2]);
+    int version = atoi(argv[3]);
+    int new_version = 0;
+    
+    printf("Roll password with ID %d back to version %d? (y/n): ", id, version);
+    char confirm;
+    scanf(" %c", &confirm);
+    
+    if (confirm != 'y' && confirm != 'Y') {
+        printf("Rollback cancelled.\n");
+        return 1;
+    }
+    
+    if (api_rollback_password(config, id, version, &new_version)) {
+        printf("Password rolled back successfully (now version %d).\n", new_version);
+        return 1;
+    } else {
+        fprintf(stderr, "Failed to roll back password.\n");
+        return 0;
+    }
+}
+
+static void print_rotate_usage() {
+    fprintf(stderr, "Usage: vault rotate (--tag <tag>... | --ids <id,id,...>) "
+                    "[--policy <name>] [--length <n>] [--classes <luds>] [--yes]\n");
+}
+
+int cmd_rotate(Config *config, int argc, char **argv) {
+    char *tags[argc];
+    int tag_count = 0;
+    char *ids = NULL;
+    int assume_yes = 0;
+    const char *policy_name = "default";
+    const char *length = NULL;
+    const char *classes = NULL;
+    PasswordPolicy policy;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--tag") == 0 && i + 1 < argc) {
+            tags[tag_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--ids") == 0 && i + 1 < argc) {
+            ids = argv[++i];
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy_name = argv[++i];
+        } else if (strcmp(argv[i], "--length") == 0 && i + 1 < argc) {
+            length = argv[++i];
+        } else if (strcmp(argv[i], "--classes") == 0 && i + 1 < argc) {
+            classes = argv[++i];
+        } else if (strcmp(argv[i], "--yes") == 0 || strcmp(argv[i], "-y") == 0) {
+            assume_yes = 1;
+        } else {
+            print_rotate_usage();
+            return 0;
+        }
+    }
+    
+    if ((tag_count > 0) == (ids != NULL)) {
+        print_rotate_usage();
+        return 0;
+    }
+    
+    // Overrides are applied after the loop so they win whatever the option order
+    if (!find_policy(policy_name, &policy)) {
+        fprintf(stderr, "Unknown policy: %s\n", policy_name);
+        print_policies();
+        return 0;
+    }
+    
+    if (length) {
+        policy.length = atoi(length);
+    }
+    
+    if (classes) {
+        strncpy(policy.classes, classes, sizeof(policy.classes) - 1);
+        policy.classes[sizeof(policy.classes) - 1] = '\0';
+    }
+    
+    Rotation *rotations;
+    int count = 0;
+    
+    if (ids) {
+        rotations = (Rotation *)calloc(strlen(ids) / 2 + 1, sizeof(Rotation));
+        for (char *id = strtok(ids, ","); id; id = strtok(NULL, ",")) {
+            char *end;
+            long value = strtol(id, &end, 10);
+            
+            if (*end != '\0' || value <= 0 || value > INT_MAX) {
+                fprintf(stderr, "Invalid password ID: %s\n", id);
+                free(rotations);
+                return 0;
+            }
+            
+            rotations[count++].id = (int)value;
+        }
+    } else {
+        int *matched;
+        
+        // Only ids come back, the current secrets never leave the server
+        if (!api_get_password_ids(config, tags, tag_count, &matched, &count)) {
+            fprintf(stderr, "Failed to retrieve passwords.\n");
+            return 0;
+        }
+        
+        rotations = (Rotation *)calloc(count > 0 ? count : 1, sizeof(Rotation));
+        for (int i = 0; i < count; i++) {
+            rotations[i].id = matched[i];
+        }
+        free(matched);
+    }
+    
+    if (count == 0) {
+        printf("No passwords to rotate.\n");
+        free(rotations);
+        return 1;
+    }
+    
+    if (!assume_yes) {
+        printf("Rotate %d password(s)? (y/n): ", count);
+        char confirm;
+        scanf(" %c", &confirm);
+        
+        if (confirm != 'y' && confirm != 'Y') {
+            printf("Rotation cancelled.\n");
+            free(rotations);
+            return 1;
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (!generate_password(&policy, rotations[i].password, sizeof(rotations[i].password))) {
+            free(rotations);
+            return 0;
+        }
+    }
+    
+    if (!api_rotate_passwords(config, rotations, count)) {
+        fprintf(stderr, "Failed to rotate passwords. No changes were applied.\n");
+        free(rotations);
+        return 0;
+    }
+    
+    printf("ID  | Old version | New version\n");
+    printf("----+-------------+------------\n");
+    
+    for (int i = 0; i < count; i++) {
+        printf("%-3d | %-11d | %d\n", 
+               rotations[i].id, 
+               rotations[i].old_version, 
+               rotations[i].new_version);
+    }
+    
+    // Generated secrets stay only in the vault
+    memset(rotations, 0, sizeof(Rotation) * count);
+    free(rotations);
+    return 1;
+}
+
+int cmd_backup(Config *config, int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: vault backup <file>\n");
+        return 0;
+    }
+    
+    if (api_download_snapshot(config, argv[2])) {
+        printf("Backup saved to %s\n", argv[2]);
+        return 1;
+    } else {
+        fprintf(stderr, "Failed to back up vault.\n");
+        return 0;
+    }
+}
+
+int cmd_restore(Config *config, int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: vault restore <file>\n");
+        return 0;
+    }
+    
+    printf("Replace the entire vault with the contents of %s? (y/n): ", argv[2]);
+    char confirm;
+    scanf(" %c", &confirm);
+    
+    if (confirm != 'y' && confirm != 'Y') {
+        printf("Restore cancelled.\n");
+        return 1;
+    }
+    
+    if (api_restore_snapshot(config, argv[2])) {
+        printf("Vault restored successfully.\n");
+        return 1;
+    } else {
+        fprintf(stderr, "Failed to restore vault.\n");
+        return 0;
+    }
+}
+
 void print_help() {
     printf("Usage: vault <command> [options]\n\n");
     printf("Commands:\n");
     printf("  configure      Configure the vault client\n");
-    printf("  list           List all passwords\n");
+    printf("  list [--tag <tag>]...\n");
+    printf("                 List passwords, optionally only those with every given tag\n");
     printf("  get <id>       Get a specific password\n");
     printf("  add            Add a new password\n");
     printf("  update <id>    Update an existing password\n");
     printf("  delete <id>    Delete a password\n");
+    printf("  history <id>   Show the saved versions of a password\n");
+    printf("  rollback <id> <version>\n");
+    printf("                 Restore a password to an earlier version\n");
+    printf("  rotate (--tag <tag>... | --ids <id,id,...>) [--policy <name>]\n");
+    printf("         [--length <n>] [--classes <luds>] [--yes]\n");
+    printf("                 Replace passwords with generated ones in one batch\n");
+    printf("  backup <file>  Download a compressed snapshot of the vault\n");
+    printf("  restore <file> Replace the vault with a snapshot from backup\n");
     printf("  help           Show this help message\n");
 }
@@ -9,6 +9,11 @@ int cmd_get(Config *config, int argc, char **argv);
 int cmd_add(Config *config, int argc, char **argv);
 int cmd_update(Config *config, int argc, char **argv);
 int cmd_delete(Config *config, int argc, char **argv);
+int cmd_history(Config *config, int argc, char **argv);
+int cmd_rollback(Config *config, int argc, char **argv);
+int cmd_rotate(Config *config, int argc, char **argv);
+int cmd_backup(Config *config, int argc, char **argv);
+int cmd_restore(Config *config, int argc, char **argv);
 void print_help();
 
 #endif
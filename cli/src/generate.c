@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "generate.h"
+
+#define RANDOM_BUFFER_SIZE 4096
+
+static const PasswordPolicy policies[] = {
+    { "default", 20, "luds" },
+    { "strong",  32, "luds" },
+    { "alnum",   24, "lud" },
+    { "pin",     6,  "d" },
+};
+
+static const char *class_chars(char class) {
+    switch (class) {
+        case 'l': return "abcdefghijklmnopqrstuvwxyz";
+        case 'u': return "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        case 'd': return "0123456789";
+        case 's': return "!@#$%^&*()-_=+[]{};:,.<>?";
+        default:  return NULL;
+    }
+}
+
+// Bytes come from the kernel CSPRNG in bulk so large rotations don't pay a
+// read per character.
+static int random_byte(unsigned char *byte) {
+    static FILE *urandom = NULL;
+    static unsigned char buffer[RANDOM_BUFFER_SIZE];
+    static size_t available = 0;
+    static size_t offset = 0;
+    
+    if (offset == available) {
+        if (!urandom && !(urandom = fopen("/dev/urandom", "rb"))) {
+            fprintf(stderr, "Failed to open /dev/urandom\n");
+            return 0;
+        }
+        
+        available = fread(buffer, 1, sizeof(buffer), urandom);
+        offset = 0;
+        
+        if (available == 0) {
+            fprintf(stderr, "Failed to read random bytes\n");
+            return 0;
+        }
+    }
+    
+    *byte = buffer[offset++];
+    return 1;
+}
+
+// Rejection sampling keeps every character equally likely
+static int random_index(size_t n, size_t *index) {
+    unsigned int limit = 256 - (256 % n);
+    unsigned char byte;
+    
+    do {
+        if (!random_byte(&byte)) {
+            return 0;
+        }
+    } while (byte >= limit);
+    
+    *index = byte % n;
+    return 1;
+}
+
+int find_policy(const char *name, PasswordPolicy *policy) {
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            *policy = policies[i];
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+int generate_password(const PasswordPolicy *policy, char *out, size_t size) {
+    char alphabet[128] = "";
+    int class_count = strlen(policy->classes);
+    
+    for (int i = 0; i < class_count; i++) {
+        const char *chars = class_chars(policy->classes[i]);
+        if (!chars) {
+            fprintf(stderr, "Unknown character class: %c\n", policy->classes[i]);
+            return 0;
+        }
+        
+        if (!strchr(alphabet, chars[0])) {
+            strcat(alphabet, chars);
+        }
+    }
+    
+    size_t alphabet_len = strlen(alphabet);
+    if (alphabet_len == 0 || policy->length < class_count || 
+        policy->length > MAX_GENERATED_LENGTH || (size_t)policy->length >= size) {
+        fprintf(stderr, "Invalid password policy\n");
+        return 0;
+    }
+    
+    // Redraw until every requested class shows up at least once
+    for (;;) {
+        for (int i = 0; i < policy->length; i++) {
+            size_t index;
+            if (!random_index(alphabet_len, &index)) {
+                return 0;
+            }
+            out[i] = alphabet[index];
+        }
+        out[policy->length] = '\0';
+        
+        int complete = 1;
+        for (int i = 0; i < class_count && complete; i++) {
+            complete = strpbrk(out, class_chars(policy->classes[i])) != NULL;
+        }
+        
+        if (complete) {
+            return 1;
+        }
+    }
+}
+
+void print_policies() {
+    printf("Policies:\n");
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        printf("  %-8s %3d characters, classes %s\n", 
+               policies[i].name, policies[i].length, policies[i].classes);
+    }
+}
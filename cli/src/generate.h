@@ -0,0 +1,19 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include <stddef.h>
+
+#define MAX_GENERATED_LENGTH 1023
+
+// Character classes: l = lowercase, u = uppercase, d = digits, s = symbols
+typedef struct {
+    const char *name;
+    int length;
+    char classes[8];
+} PasswordPolicy;
+
+int find_policy(const char *name, PasswordPolicy *policy);
+int generate_password(const PasswordPolicy *policy, char *out, size_t size);
+void print_policies();
+
+#endif
@@ -32,6 +32,16 @@ int main(int argc, char **argv) {
             result = cmd_update(&config, argc, argv);
         } else if (strcmp(argv[1], "delete") == 0) {
             result = cmd_delete(&config, argc, argv);
+        } else if (strcmp(argv[1], "history") == 0) {
+            result = cmd_history(&config, argc, argv);
+        } else if (strcmp(argv[1], "rollback") == 0) {
+            result = cmd_rollback(&config, argc, argv);
+        } else if (strcmp(argv[1], "rotate") == 0) {
+            result = cmd_rotate(&config, argc, argv);
+        } else if (strcmp(argv[1], "backup") == 0) {
+            result = cmd_backup(&config, argc, argv);
+        } else if (strcmp(argv[1], "restore") == 0) {
+            result = cmd_restore(&config, argc, argv);
         } else if (strcmp(argv[1], "help") == 0) {
             print_help();
             result = 1;
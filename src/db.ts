@@ -1,8 +1,13 @@
-import { Database } from "sqlite3";
-import { mkdir } from "node:fs/promises";
+import { Database, OPEN_CREATE, OPEN_READONLY, OPEN_READWRITE, RunResult, Statement } from "sqlite3";
+import { mkdir, rm } from "node:fs/promises";
+import { randomBytes } from "node:crypto";
 import { dirname } from "node:path";
+import { deflateRawSync, inflateRawSync } from "node:zlib";
 
-const DB_PATH = process.env.DB_PATH || "./data/vault.db";
+export const DB_PATH = process.env.DB_PATH || "./data/vault.db";
+
+// History rows with notes below this size are stored as plain text
+const NOTES_COMPRESSION_THRESHOLD = 256;
 
 async function ensureDbDir() {
   try {
@@ -12,51 +17,399 @@ async function ensureDbDir() {
   }
 }
 
-export async function initDb(): Promise<Database> {
-  await ensureDbDir();
-  
+const SCHEMA = [
+  `PRAGMA foreign_keys = ON`,
+  // WAL lets snapshot readers on their own connection run alongside writers
+  `PRAGMA journal_mode = WAL`,
+  `
+    CREATE TABLE IF NOT EXISTS passwords (
+      id INTEGER PRIMARY KEY AUTOINCREMENT,
+      title TEXT NOT NULL,
+      username TEXT NOT NULL,
+      password TEXT NOT NULL,
+      url TEXT,
+      notes TEXT,
+      created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+      updated_at TEXT DEFAULT CURRENT_TIMESTAMP
+    )
+  `,
+  `
+    CREATE TABLE IF NOT EXISTS tags (
+      id INTEGER PRIMARY KEY AUTOINCREMENT,
+      name TEXT NOT NULL UNIQUE
+    )
+  `,
+  `
+    CREATE TABLE IF NOT EXISTS password_tags (
+      password_id INTEGER NOT NULL REFERENCES passwords(id) ON DELETE CASCADE,
+      tag_id INTEGER NOT NULL REFERENCES tags(id) ON DELETE CASCADE,
+      PRIMARY KEY (password_id, tag_id)
+    ) WITHOUT ROWID
+  `,
+  // Tag filters walk tag -> passwords, the primary key covers the reverse
+  `CREATE INDEX IF NOT EXISTS idx_password_tags_tag ON password_tags (tag_id, password_id)`,
+  // Append-only; every write to an entry adds its resulting state here. There
+  // is deliberately no foreign key to passwords: deleting an entry appends a
+  // tombstone version and keeps everything before it restorable.
+  `
+    CREATE TABLE IF NOT EXISTS password_history (
+      password_id INTEGER NOT NULL,
+      version INTEGER NOT NULL,
+      title TEXT NOT NULL,
+      username TEXT NOT NULL,
+      password TEXT NOT NULL,
+      url TEXT,
+      notes BLOB,
+      notes_compressed INTEGER NOT NULL DEFAULT 0,
+      tags TEXT NOT NULL DEFAULT '[]',
+      deleted INTEGER NOT NULL DEFAULT 0,
+      created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+      PRIMARY KEY (password_id, version)
+    ) WITHOUT ROWID
+  `,
+];
+
+// One-time data migrations, run in order after SCHEMA. PRAGMA user_version
+// records how many have been applied, so each runs once per database.
+const MIGRATIONS = [
+  // Entries written before history existed start out as version 1
+  [
+    `
+      INSERT INTO password_history (password_id, version, title, username, password, url, notes, tags, created_at)
+      SELECT p.id, 1, p.title, p.username, p.password, p.url, p.notes,
+        (SELECT json_group_array(t.name)
+           FROM password_tags pt JOIN tags t ON t.id = pt.tag_id
+          WHERE pt.password_id = p.id),
+        p.updated_at
+      FROM passwords p
+      WHERE NOT EXISTS (SELECT 1 FROM password_history h WHERE h.password_id = p.id)
+    `,
+  ],
+];
+
+async function applySchema(db: Database): Promise<void> {
+  for (const statement of SCHEMA) {
+    await run(db, statement);
+  }
+
+  const current = await get<{ user_version: number }>(db, "PRAGMA user_version");
+
+  for (let version = current?.user_version ?? 0; version < MIGRATIONS.length; version++) {
+    await run(db, "BEGIN IMMEDIATE");
+
+    try {
+      for (const statement of MIGRATIONS[version]) {
+        await run(db, statement);
+      }
+      await run(db, `PRAGMA user_version = ${version + 1}`);
+      await run(db, "COMMIT");
+    } catch (error) {
+      await run(db, "ROLLBACK").catch(() => {});
+      throw error;
+    }
+  }
+}
+
+function openDatabase(path: string, mode = OPEN_READWRITE | OPEN_CREATE): Promise<Database> {
   return new Promise((resolve, reject) => {
-    const db = new Database(DB_PATH, async (err) => {
+    const db = new Database(path, mode, (err) => {
       if (err) {
-        console.error("Database opening error:", err);
         reject(err);
         return;
       }
 
-      db.serialize(() => {
-        db.run(`
-          CREATE TABLE IF NOT EXISTS passwords (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            title TEXT NOT NULL,
-            username TEXT NOT NULL,
-            password TEXT NOT NULL,
-            url TEXT,
-            notes TEXT,
-            created_at TEXT DEFAULT CURRENT_TIMESTAMP,
-            updated_at TEXT DEFAULT CURRENT_TIMESTAMP
-          )
-        `, (err) => {
-          if (err) {
-            console.error("Table creation error:", err);
-            reject(err);
-            return;
-          }
-
-          console.log("Database initialized successfully");
-          resolve(db);
-        });
-      });
+      resolve(db);
     });
   });
 }
 
-let dbInstance: Database | null = null;
+function closeDatabase(db: Database): Promise<void> {
+  return new Promise((resolve, reject) => {
+    db.close((err) => {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      resolve();
+    });
+  });
+}
+
+// Reads and writes use separate connections. Under WAL the read connection
+// only ever sees committed data, so readers never observe a transaction
+// that is still open (or later rolled back) on the write connection.
+interface Connections {
+  reader: Database;
+  writer: Database;
+}
+
+async function openConnections(): Promise<Connections> {
+  await ensureDbDir();
+  
+  const writer = await openDatabase(DB_PATH).catch((err) => {
+    console.error("Database opening error:", err);
+    throw err;
+  });
+
+  try {
+    await applySchema(writer);
+  } catch (err) {
+    console.error("Table creation error:", err);
+    throw err;
+  }
+
+  const reader = await openDatabase(DB_PATH, OPEN_READONLY);
+
+  console.log("Database initialized successfully");
+  return { reader, writer };
+}
+
+let connections: Promise<Connections> | null = null;
+
+// The promise is shared so startup warm-up and early requests open the
+// database only once.
+function getConnections(): Promise<Connections> {
+  if (!connections) {
+    connections = openConnections().catch((error) => {
+      connections = null;
+      throw error;
+    });
+  }
+  return connections;
+}
 
+// Read-only connection for queries outside a transaction
 export async function getDb(): Promise<Database> {
-  if (!dbInstance) {
-    dbInstance = await initDb();
+  return (await getConnections()).reader;
+}
+
+// Write connection; only use it from inside withTransaction
+export async function getWriteDb(): Promise<Database> {
+  return (await getConnections()).writer;
+}
+
+// Hot queries are compiled once per connection at startup. The helpers below
+// reuse a statement only when it was prepared on the connection they are
+// given; any other SQL is prepared per call.
+const statements = new WeakMap<Database, Map<string, Statement>>();
+
+function preparedStatement(db: Database, sql: string): Statement | undefined {
+  return statements.get(db)?.get(sql);
+}
+
+export function prepareStatements(db: Database, sqls: string[]): Promise<void[]> {
+  let cache = statements.get(db);
+  if (!cache) {
+    cache = new Map();
+    statements.set(db, cache);
+  }
+
+  const prepared = cache;
+
+  return Promise.all(sqls.map(sql => new Promise<void>((resolve, reject) => {
+    if (prepared.has(sql)) {
+      resolve();
+      return;
+    }
+
+    const statement = db.prepare(sql, (err) => {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      prepared.set(sql, statement);
+      resolve();
+    });
+  })));
+}
+
+export function run(db: Database, sql: string, params: unknown[] = []): Promise<RunResult> {
+  return new Promise((resolve, reject) => {
+    const callback = function(this: RunResult, err: Error | null) {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      resolve(this);
+    };
+    const statement = preparedStatement(db, sql);
+
+    if (statement) {
+      statement.run(params, callback);
+    } else {
+      db.run(sql, params, callback);
+    }
+  });
+}
+
+export function all<T>(db: Database, sql: string, params: unknown[] = []): Promise<T[]> {
+  return new Promise((resolve, reject) => {
+    const callback = (err: Error | null, rows: T[]) => {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      resolve(rows);
+    };
+    const statement = preparedStatement(db, sql);
+
+    if (statement) {
+      statement.all(params, callback);
+    } else {
+      db.all(sql, params, callback);
+    }
+  });
+}
+
+export function get<T>(db: Database, sql: string, params: unknown[] = []): Promise<T | undefined> {
+  return new Promise((resolve, reject) => {
+    const callback = (err: Error | null, row: T | undefined) => {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      resolve(row);
+    };
+    const statement = preparedStatement(db, sql);
+
+    if (statement) {
+      // A stepped statement keeps its read open until it is reset
+      statement.get(params, callback).reset();
+    } else {
+      db.get(sql, params, callback);
+    }
+  });
+}
+
+// Reads every table and index behind the hot statements end to end. This
+// mostly warms the OS page cache: SQLite's own cache (2 MB by default) only
+// keeps the most recently read pages of a large vault. The range conditions
+// steer each scan onto a specific b-tree.
+const PRELOAD_QUERIES = [
+  "SELECT SUM(LENGTH(title || username || password || COALESCE(url, '') || COALESCE(notes, ''))) FROM passwords",
+  "SELECT SUM(tag_id) FROM password_tags WHERE password_id >= 0",
+  "SELECT SUM(password_id) FROM password_tags WHERE tag_id >= 0",
+  "SELECT SUM(LENGTH(name)) FROM tags NOT INDEXED",
+  "SELECT COUNT(*) FROM tags WHERE name >= ''",
+  `SELECT SUM(LENGTH(title || username || password || COALESCE(url, '') || COALESCE(notes, '') || tags))
+   FROM password_history`,
+];
+
+export async function preloadPages(db: Database): Promise<void> {
+  for (const sql of PRELOAD_QUERIES) {
+    await get(db, sql);
+  }
+}
+
+// Writes are queued so statements from different transactions never
+// interleave on the write connection.
+let writeQueue: Promise<unknown> = Promise.resolve();
+
+function exclusive<T>(fn: (db: Database) => Promise<T>): Promise<T> {
+  const result = writeQueue.then(async () => fn(await getWriteDb()));
+
+  writeQueue = result.catch(() => {});
+  return result;
+}
+
+export function withTransaction<T>(fn: (db: Database) => Promise<T>): Promise<T> {
+  return exclusive(async (db) => {
+    await run(db, "BEGIN IMMEDIATE");
+
+    try {
+      const value = await fn(db);
+      await run(db, "COMMIT");
+      return value;
+    } catch (error) {
+      await run(db, "ROLLBACK").catch(() => {});
+      throw error;
+    }
+  });
+}
+
+export function snapshotPath(): string {
+  return `${DB_PATH}.snapshot-${Date.now()}-${randomBytes(4).toString("hex")}`;
+}
+
+// VACUUM INTO runs on its own connection, so under WAL it reads a consistent
+// view without holding up writers on the shared one. Returns the path of the
+// snapshot file, which the caller removes when done with it.
+export async function createSnapshot(): Promise<string> {
+  const path = snapshotPath();
+  const db = await openDatabase(DB_PATH);
+
+  try {
+    await run(db, "VACUUM INTO ?", [path]);
+    return path;
+  } catch (error) {
+    await rm(path, { force: true });
+    throw error;
+  } finally {
+    await closeDatabase(db);
+  }
+}
+
+// Raised when an uploaded snapshot is not a usable vault database, as
+// opposed to the server failing to restore a good one
+export class InvalidSnapshotError extends Error {}
+
+function isCorruptFileError(error: unknown): boolean {
+  const code = (error as { code?: string }).code;
+  return code === "SQLITE_NOTADB" || code === "SQLITE_CORRUPT";
+}
+
+// Checks an uploaded snapshot and brings its schema up to date in place, so
+// the live database never passes through an older schema during restore.
+async function prepareSnapshot(path: string): Promise<void> {
+  const db = await openDatabase(path, OPEN_READWRITE);
+
+  try {
+    const integrity = await get<{ integrity_check: string }>(db, "PRAGMA integrity_check").catch((error) => {
+      throw isCorruptFileError(error) ? new InvalidSnapshotError("Snapshot is not a database") : error;
+    });
+    if (integrity?.integrity_check !== "ok") {
+      throw new InvalidSnapshotError("Snapshot failed integrity check");
+    }
+
+    const table = await get(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'passwords'");
+    if (!table) {
+      throw new InvalidSnapshotError("Snapshot is not a vault database");
+    }
+
+    await applySchema(db);
+  } finally {
+    await closeDatabase(db);
   }
-  return dbInstance;
+}
+
+// Copies a snapshot over the live database through the backup API. The copy
+// runs on the write connection, which has no reads of its own open, and
+// readers on the other connection switch over once it commits.
+export async function restoreSnapshot(path: string): Promise<void> {
+  await prepareSnapshot(path);
+
+  await exclusive((db) => new Promise<void>((resolve, reject) => {
+    const backup = db.backup(path, "main", "main", false, (err) => {
+      if (err) {
+        reject(err);
+        return;
+      }
+
+      backup.step(-1, (err) => {
+        if (err || !backup.completed) {
+          backup.finish(() => reject(err ?? new Error("Restore did not complete")));
+          return;
+        }
+
+        backup.finish((err) => (err ? reject(err) : resolve()));
+      });
+    });
+  }));
 }
 
 export function encrypt(text: string): string {
@@ -69,3 +422,28 @@ export function decrypt(encryptedText: string): string {
   const decoded = Buffer.from(encryptedText, "base64").toString();
   return decoded.substring(0, decoded.length - key.length);
 }
+
+export function compressNotes(notes: string | null | undefined): { notes: Buffer | string | null; compressed: boolean } {
+  if (!notes || notes.length < NOTES_COMPRESSION_THRESHOLD) {
+    return { notes: notes ?? null, compressed: false };
+  }
+
+  const deflated = deflateRawSync(Buffer.from(notes));
+  if (deflated.length >= Buffer.byteLength(notes)) {
+    return { notes, compressed: false };
+  }
+
+  return { notes: deflated, compressed: true };
+}
+
+export function decompressNotes(notes: Buffer | string | null, compressed: number): string | null {
+  if (notes === null) {
+    return null;
+  }
+
+  if (!compressed) {
+    return notes.toString();
+  }
+
+  return inflateRawSync(notes as Buffer).toString();
+}
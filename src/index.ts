@@ -2,23 +2,48 @@ import { Elysia } from "elysia";
 import { cors } from "@elysiajs/cors";
 import { swagger } from "@elysiajs/swagger";
 import { passwordRoutes } from "./routes/passwords";
+import { adminRoutes } from "./routes/admin";
+import { warmUp, recordFirstResponse, startupState } from "./startup";
 
 const PORT = process.env.PORT ? parseInt(process.env.PORT) : 3000;
+const SWAGGER_ENABLED = process.env.SWAGGER
+  ? process.env.SWAGGER === "true"
+  : process.env.NODE_ENV !== "production";
+
+// Runs alongside plugin setup and listen; /ready reports when it is done
+warmUp().catch((error) => {
+  console.error("Warm-up failed:", error);
+  process.exit(1);
+});
 
 const app = new Elysia()
   .use(cors())
-  .use(swagger({
+  .onResponse(() => recordFirstResponse())
+  .use(SWAGGER_ENABLED ? swagger({
     documentation: {
       info: {
         title: "Paultry API",
         version: "1.0.0",
       },
       tags: [
-        { name: "passwords", description: "Password management endpoints" }
+        { name: "passwords", description: "Password management endpoints" },
+        { name: "admin", description: "Backup and restore endpoints" }
       ]
     }
-  }))
+  }) : (app: Elysia) => app)
+  // Registered ahead of the authenticated routes so probes need no API key
+  .get("/ready", ({ set }) => {
+    if (!startupState.ready) {
+      set.status = 503;
+    }
+
+    return {
+      success: startupState.ready,
+      data: startupState,
+    };
+  })
   .use(passwordRoutes)
+  .use(adminRoutes)
   .get("/", () => ({
     message: "Paultry API is running",
     version: "1.0.0",
@@ -0,0 +1,133 @@
+import { Elysia } from "elysia";
+import { createReadStream, createWriteStream } from "node:fs";
+import { rm } from "node:fs/promises";
+import { Readable, Transform, pipeline } from "node:stream";
+import { pipeline as pipelineAsync } from "node:stream/promises";
+import { createGunzip, createGzip } from "node:zlib";
+import { InvalidSnapshotError, createSnapshot, restoreSnapshot, snapshotPath } from "../db";
+import { authMiddleware } from "../middleware/auth";
+
+const DEFAULT_RESTORE_BYTES = 1024 * 1024 * 1024;
+
+// Decompressed restores larger than this are refused before they can fill
+// the volume holding the live database. A value that is not a positive
+// number would disable the check, so it falls back to the default instead.
+function restoreLimit(value: string | undefined): number {
+  if (value === undefined) {
+    return DEFAULT_RESTORE_BYTES;
+  }
+
+  const limit = Number(value);
+  if (!Number.isFinite(limit) || limit <= 0) {
+    console.warn(`Ignoring invalid RESTORE_MAX_BYTES "${value}", using ${DEFAULT_RESTORE_BYTES} bytes`);
+    return DEFAULT_RESTORE_BYTES;
+  }
+
+  return limit;
+}
+
+const MAX_RESTORE_BYTES = restoreLimit(process.env.RESTORE_MAX_BYTES);
+
+class SnapshotTooLargeError extends Error {}
+
+// Bad uploads are the client's fault; anything else is a server failure
+function restoreStatus(error: unknown): number {
+  if (error instanceof SnapshotTooLargeError) {
+    return 413;
+  }
+
+  const code = (error as { code?: string }).code;
+  if (error instanceof InvalidSnapshotError || code?.startsWith("Z_")) {
+    return 400;
+  }
+
+  return 500;
+}
+
+function limitBytes(max: number): Transform {
+  let total = 0;
+
+  return new Transform({
+    transform(chunk: Buffer, _encoding, callback) {
+      total += chunk.length;
+
+      if (total > max) {
+        callback(new SnapshotTooLargeError(`Snapshot exceeds ${max} bytes once decompressed`));
+        return;
+      }
+
+      callback(null, chunk);
+    },
+  });
+}
+
+export const adminRoutes = new Elysia()
+  .use(authMiddleware)
+  .group("/admin", (app) => 
+    app
+      // Passwords in the snapshot stay encrypted exactly as they are on disk
+      .get("/snapshot", async ({ set }) => {
+        try {
+          const path = await createSnapshot();
+          const gzip = createGzip();
+          
+          // pipeline() tears down both ends when the client cancels, so the
+          // callback runs on success, failure and abort alike
+          pipeline(createReadStream(path), gzip, () => {
+            rm(path, { force: true }).catch((error) => {
+              console.error("Failed to remove snapshot:", error);
+            });
+          });
+          
+          return new Response(Readable.toWeb(gzip) as ReadableStream, {
+            headers: {
+              "Content-Type": "application/gzip",
+              "Content-Disposition": `attachment; filename="vault-${Date.now()}.db.gz"`,
+            },
+          });
+        } catch (error) {
+          set.status = 500;
+          return {
+            success: false,
+            error: (error as Error).message,
+          };
+        }
+      })
+      
+      .post("/restore", 
+        async ({ request, set }) => {
+          const path = snapshotPath();
+          
+          try {
+            if (!request.body) {
+              throw new InvalidSnapshotError("Missing snapshot body");
+            }
+            
+            await pipelineAsync(
+              Readable.fromWeb(request.body as any),
+              createGunzip(),
+              limitBytes(MAX_RESTORE_BYTES),
+              createWriteStream(path)
+            );
+            await restoreSnapshot(path);
+            
+            return {
+              success: true,
+              data: { success: true },
+            };
+          } catch (error) {
+            set.status = restoreStatus(error);
+            return {
+              success: false,
+              error: (error as Error).message,
+            };
+          } finally {
+            await rm(path, { force: true });
+          }
+        },
+        {
+          // Leave the gzip body unread so it can be streamed to disk
+          parse: () => true,
+        }
+      )
+  );
@@ -1,29 +1,271 @@
 import { Elysia, t } from "elysia";
-import { getDb, encrypt, decrypt } from "../db";
-import { Password } from "../types";
+import { Database } from "sqlite3";
+import {
+  getDb, encrypt, decrypt, run, all, get, withTransaction, compressNotes, decompressNotes,
+} from "../db";
+import { Password, PasswordVersion } from "../types";
 import { authMiddleware } from "../middleware/auth";
 
+// The CLI carries tags as one comma-separated string sized for these limits
+const MAX_TAG_LENGTH = 64;
+const MAX_TAGS = 16;
+
+// Tags are aggregated per row through the password_tags primary key, so a
+// filtered listing never touches entries outside the requested tags.
+const SELECT_PASSWORD = `
+  SELECT p.*,
+    (SELECT json_group_array(t.name)
+       FROM password_tags pt JOIN tags t ON t.id = pt.tag_id
+      WHERE pt.password_id = p.id) AS tags
+  FROM passwords p
+`;
+
+const LIST_PASSWORDS = `${SELECT_PASSWORD} ORDER BY p.updated_at DESC`;
+const GET_PASSWORD = `${SELECT_PASSWORD} WHERE p.id = ?`;
+const LATEST_VERSION = "SELECT MAX(version) AS version FROM password_history WHERE password_id = ?";
+const INSERT_VERSION = `
+  INSERT INTO password_history
+    (password_id, version, title, username, password, url, notes, notes_compressed, tags)
+  VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+`;
+const UPDATE_PASSWORD = `
+  UPDATE passwords 
+  SET title = ?, username = ?, password = ?, url = ?, notes = ?, updated_at = CURRENT_TIMESTAMP
+  WHERE id = ?
+`;
+const ROTATE_PASSWORD = "UPDATE passwords SET password = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?";
+// Rotation only changes the password, so the new history row takes it from
+// passwords and reuses the latest version's already-compressed notes and tags
+const ROTATE_VERSION = `
+  INSERT INTO password_history
+    (password_id, version, title, username, password, url, notes, notes_compressed, tags)
+  SELECT p.id, h.version + 1, p.title, p.username, p.password, p.url, h.notes, h.notes_compressed, h.tags
+  FROM passwords p JOIN password_history h ON h.password_id = p.id
+  WHERE p.id = ?
+  ORDER BY h.version DESC
+  LIMIT 1
+  RETURNING version
+`;
+const LIST_HISTORY = "SELECT * FROM password_history WHERE password_id = ? ORDER BY version DESC";
+// Repeats the latest version marked as deleted, so history outlives the entry
+const INSERT_TOMBSTONE = `
+  INSERT INTO password_history
+    (password_id, version, title, username, password, url, notes, notes_compressed, tags, deleted)
+  SELECT password_id, version + 1, title, username, password, url, notes, notes_compressed, tags, 1
+  FROM password_history
+  WHERE password_id = ?
+  ORDER BY version DESC
+  LIMIT 1
+`;
+const RESTORE_PASSWORD = `
+  INSERT INTO passwords (id, title, username, password, url, notes)
+  VALUES (?, ?, ?, ?, ?, ?)
+`;
+
+// Fixed statements on the read and rotation paths, prepared during startup
+// warm-up on the connection that runs them
+export const HOT_READS = [
+  LIST_PASSWORDS,
+  GET_PASSWORD,
+  LIST_HISTORY,
+];
+
+export const HOT_WRITES = [
+  GET_PASSWORD,
+  LATEST_VERSION,
+  INSERT_VERSION,
+  UPDATE_PASSWORD,
+  ROTATE_PASSWORD,
+  ROTATE_VERSION,
+];
+
+// ?tag=a&tag=b arrives as an array, a single ?tag=a as a string
+const TAG_QUERY = t.Object({
+  tag: t.Optional(t.Union([t.String(), t.Array(t.String())])),
+});
+
+type PasswordRow = Omit<Password, "tags"> & { tags: string };
+
+function toPassword(row: PasswordRow): Password {
+  return {
+    ...row,
+    password: decrypt(row.password),
+    tags: JSON.parse(row.tags),
+  };
+}
+
+function normalizeTags(tags: string | string[] | undefined): string[] {
+  if (tags === undefined) {
+    return [];
+  }
+
+  const names = [...new Set((Array.isArray(tags) ? tags : [tags]).map(tag => tag.trim()))];
+
+  if (names.length > MAX_TAGS) {
+    throw new Error(`Too many tags: at most ${MAX_TAGS} are allowed`);
+  }
+
+  for (const name of names) {
+    if (name.length === 0 || Buffer.byteLength(name) > MAX_TAG_LENGTH || name.includes(",")) {
+      throw new Error(`Invalid tag: "${name}"`);
+    }
+  }
+
+  return names;
+}
+
+async function setPasswordTags(db: Database, passwordId: number, tags: string[]) {
+  await run(db, "DELETE FROM password_tags WHERE password_id = ?", [passwordId]);
+
+  if (tags.length === 0) {
+    return;
+  }
+
+  const placeholders = tags.map(() => "?").join(", ");
+
+  await run(
+    db,
+    `INSERT OR IGNORE INTO tags (name) VALUES ${tags.map(() => "(?)").join(", ")}`,
+    tags
+  );
+  await run(
+    db,
+    `INSERT INTO password_tags (password_id, tag_id)
+     SELECT ?, id FROM tags WHERE name IN (${placeholders})`,
+    [passwordId, ...tags]
+  );
+}
+
+type HistoryRow = Omit<PasswordVersion, "notes" | "tags" | "deleted"> & {
+  password_id: number;
+  notes: Buffer | string | null;
+  notes_compressed: number;
+  tags: string;
+  deleted: number;
+};
+
+function toPasswordVersion(row: HistoryRow): PasswordVersion {
+  const { password_id, notes_compressed, ...version } = row;
+
+  return {
+    ...version,
+    id: password_id,
+    password: decrypt(row.password),
+    notes: decompressNotes(row.notes, notes_compressed) ?? undefined,
+    tags: JSON.parse(row.tags),
+    deleted: row.deleted === 1,
+  };
+}
+
+// Appends the entry's current state to its history and returns the new version
+async function recordVersion(db: Database, passwordId: number): Promise<number> {
+  const row = await get<PasswordRow>(db, GET_PASSWORD, [passwordId]);
+  if (!row) {
+    throw new Error("Password not found");
+  }
+
+  const { notes, compressed } = compressNotes(row.notes);
+  const latest = await get<{ version: number | null }>(db, LATEST_VERSION, [passwordId]);
+  const version = (latest?.version ?? 0) + 1;
+
+  await run(
+    db,
+    INSERT_VERSION,
+    [passwordId, version, row.title, row.username, row.password, row.url, notes, compressed ? 1 : 0, row.tags]
+  );
+
+  return version;
+}
+
+// Entries must carry every requested tag
+function tagFilter(tags: string[]): { where: string; params: unknown[] } {
+  if (tags.length === 0) {
+    return { where: "", params: [] };
+  }
+
+  return {
+    where: `
+      WHERE p.id IN (
+        SELECT pt.password_id
+          FROM tags t JOIN password_tags pt ON pt.tag_id = t.id
+         WHERE t.name IN (${tags.map(() => "?").join(", ")})
+         GROUP BY pt.password_id
+        HAVING COUNT(*) = ?
+      )
+    `,
+    params: [...tags, tags.length],
+  };
+}
+
+async function listPasswords(db: Database, tags: string[]): Promise<Password[]> {
+  if (tags.length === 0) {
+    const rows = await all<PasswordRow>(db, LIST_PASSWORDS);
+    return rows.map(toPassword);
+  }
+
+  const { where, params } = tagFilter(tags);
+  const rows = await all<PasswordRow>(db, `${SELECT_PASSWORD} ${where} ORDER BY p.updated_at DESC`, params);
+  return rows.map(toPassword);
+}
+
+// Ids only, for callers such as bulk rotation that never need the secrets
+async function listPasswordIds(db: Database, tags: string[]): Promise<number[]> {
+  const { where, params } = tagFilter(tags);
+  const rows = await all<{ id: number }>(db, `SELECT p.id FROM passwords p ${where} ORDER BY p.id`, params);
+  return rows.map(row => row.id);
+}
+
 export const passwordRoutes = new Elysia()
   .use(authMiddleware)
   .group("/passwords", (app) => 
     app
-      .get("/", async () => {
+      .get("/", 
+        async ({ query }) => {
+          const db = await getDb();
+          
+          return Promise.resolve()
+            .then(() => listPasswords(db, normalizeTags(query.tag)))
+            .then(data => ({
+              success: true,
+              data,
+            })).catch(error => ({
+              success: false,
+              error: error.message,
+            }));
+        },
+        {
+          query: TAG_QUERY,
+        }
+      )
+      
+      .get("/ids", 
+        async ({ query }) => {
+          const db = await getDb();
+          
+          return Promise.resolve()
+            .then(() => listPasswordIds(db, normalizeTags(query.tag)))
+            .then(data => ({
+              success: true,
+              data,
+            })).catch(error => ({
+              success: false,
+              error: error.message,
+            }));
+        },
+        {
+          query: TAG_QUERY,
+        }
+      )
+      
+      .get("/:id", async ({ params }) => {
         const db = await getDb();
         
-        return new Promise<Password[]>((resolve, reject) => {
-          db.all("SELECT * FROM passwords ORDER BY updated_at DESC", (err, rows: Password[]) => {
-            if (err) {
-              reject(err);
-              return;
-            }
-            
-            const decryptedRows = rows.map(row => ({
-              ...row,
-              password: decrypt(row.password),
-            }));
-            
-            resolve(decryptedRows);
-          });
+        return get<PasswordRow>(db, GET_PASSWORD, [params.id]).then(row => {
+          if (!row) {
+            throw new Error("Password not found");
+          }
+          
+          return toPassword(row);
         }).then(data => ({
           success: true,
           data,
@@ -33,24 +275,15 @@ export const passwordRoutes = new Elysia()
         }));
       })
       
-      .get("/:id", async ({ params }) => {
+      .get("/:id/history", async ({ params }) => {
         const db = await getDb();
         
-        return new Promise<Password>((resolve, reject) => {
-          db.get("SELECT * FROM passwords WHERE id = ?", [params.id], (err, row: Password) => {
-            if (err) {
-              reject(err);
-              return;
-            }
-            
-            if (!row) {
-              reject(new Error("Password not found"));
-              return;
-            }
-            
-            row.password = decrypt(row.password);
-            resolve(row);
-          });
+        return all<HistoryRow>(db, LIST_HISTORY, [params.id]).then(rows => {
+          if (rows.length === 0) {
+            throw new Error("Password not found");
+          }
+          
+          return rows.map(toPasswordVersion);
         }).then(data => ({
           success: true,
           data,
@@ -60,27 +293,117 @@ export const passwordRoutes = new Elysia()
         }));
       })
       
+      .post("/:id/rollback", 
+        async ({ params, body }) => {
+          const passwordId = Number(params.id);
+          
+          // Restoring an old version is itself recorded as a new version
+          return withTransaction(async (db) => {
+            const row = await get<HistoryRow>(
+              db,
+              "SELECT * FROM password_history WHERE password_id = ? AND version = ?",
+              [passwordId, body.version]
+            );
+            
+            if (!row) {
+              throw new Error("Version not found");
+            }
+            
+            if (row.deleted) {
+              throw new Error("Cannot roll back to a deleted version");
+            }
+            
+            const notes = decompressNotes(row.notes, row.notes_compressed);
+            const result = await run(
+              db,
+              UPDATE_PASSWORD,
+              [row.title, row.username, row.password, row.url, notes, passwordId]
+            );
+            
+            // Deleted entries come back under their original id
+            if (result.changes === 0) {
+              await run(
+                db,
+                RESTORE_PASSWORD,
+                [passwordId, row.title, row.username, row.password, row.url, notes]
+              );
+            }
+            await setPasswordTags(db, passwordId, JSON.parse(row.tags));
+            
+            return { success: true, version: await recordVersion(db, passwordId) };
+          }).then(data => ({
+            success: true,
+            data,
+          })).catch(error => ({
+            success: false,
+            error: error.message,
+          }));
+        },
+        {
+          body: t.Object({
+            version: t.Number(),
+          }),
+        }
+      )
+      
+      .post("/rotate", 
+        async ({ body }) => {
+          // The whole batch commits or rolls back together
+          return withTransaction(async (db) => {
+            const rotated: { id: number; old_version: number; new_version: number }[] = [];
+            
+            for (const { id, password } of body.updates) {
+              const result = await run(db, ROTATE_PASSWORD, [encrypt(password), id]);
+              
+              if (result.changes === 0) {
+                throw new Error(`Password not found: ${id}`);
+              }
+              
+              // Versions are appended contiguously, so the previous one is always version - 1
+              const row = await get<{ version: number }>(db, ROTATE_VERSION, [id]);
+              if (!row) {
+                throw new Error(`No history for password: ${id}`);
+              }
+              
+              rotated.push({ id, old_version: row.version - 1, new_version: row.version });
+            }
+            
+            return rotated;
+          }).then(data => ({
+            success: true,
+            data,
+          })).catch(error => ({
+            success: false,
+            error: error.message,
+          }));
+        },
+        {
+          body: t.Object({
+            updates: t.Array(t.Object({
+              id: t.Number(),
+              password: t.String(),
+            })),
+          }),
+        }
+      )
+      
       .post("/", 
         async ({ body }) => {
-          const db = await getDb();
           const { title, username, password, url, notes } = body;
           
           const encryptedPassword = encrypt(password);
           
-          return new Promise<{ id: number }>((resolve, reject) => {
-            db.run(
+          return withTransaction(async (db) => {
+            const tags = normalizeTags(body.tags);
+            const result = await run(
+              db,
               `INSERT INTO passwords (title, username, password, url, notes) 
                VALUES (?, ?, ?, ?, ?)`,
-              [title, username, encryptedPassword, url, notes],
-              function(err) {
-                if (err) {
-                  reject(err);
-                  return;
-                }
-                
-                resolve({ id: this.lastID });
-              }
+              [title, username, encryptedPassword, url, notes]
             );
+            
+            await setPasswordTags(db, result.lastID, tags);
+            return { id: result.lastID, version: await recordVersion(db, result.lastID) };
           }).then(data => ({
             success: true,
             data,
@@ -96,37 +419,34 @@ export const passwordRoutes = new Elysia()
             password: t.String(),
             url: t.Optional(t.String()),
             notes: t.Optional(t.String()),
+            tags: t.Optional(t.Array(t.String())),
           }),
         }
       )
       
       .put("/:id", 
         async ({ params, body }) => {
-          const db = await getDb();
           const { title, username, password, url, notes } = body;
           
           const encryptedPassword = encrypt(password);
           
-          return new Promise<{ success: boolean }>((resolve, reject) => {
-            db.run(
-              `UPDATE passwords 
-               SET title = ?, username = ?, password = ?, url = ?, notes = ?, updated_at = CURRENT_TIMESTAMP
-               WHERE id = ?`,
-              [title, username, encryptedPassword, url, notes, params.id],
-              function(err) {
-                if (err) {
-                  reject(err);
-                  return;
-                }
-                
-                if (this.changes === 0) {
-                  reject(new Error("Password not found"));
-                  return;
-                }
-                
-                resolve({ success: true });
-              }
+          return withTransaction(async (db) => {
+            const result = await run(
+              db,
+              UPDATE_PASSWORD,
+              [title, username, encryptedPassword, url, notes, params.id]
             );
+            
+            if (result.changes === 0) {
+              throw new Error("Password not found");
+            }
+            
+            // Omitting tags leaves the existing set untouched
+            if (body.tags !== undefined) {
+              await setPasswordTags(db, Number(params.id), normalizeTags(body.tags));
+            }
+            
+            return { success: true, version: await recordVersion(db, Number(params.id)) };
           }).then(data => ({
             success: true,
             data,
@@ -142,27 +462,23 @@ export const passwordRoutes = new Elysia()
             password: t.String(),
             url: t.Optional(t.String()),
             notes: t.Optional(t.String()),
+            tags: t.Optional(t.Array(t.String())),
           }),
         }
       )
       
       .delete("/:id", async ({ params }) => {
-        const db = await getDb();
-        
-        return new Promise<{ success: boolean }>((resolve, reject) => {
-          db.run("DELETE FROM passwords WHERE id = ?", [params.id], function(err) {
-            if (err) {
-              reject(err);
-              return;
-            }
-            
-            if (this.changes === 0) {
-              reject(new Error("Password not found"));
-              return;
-            }
-            
-            resolve({ success: true });
-          });
+        // password_tags rows go with the entry through ON DELETE CASCADE;
+        // its history stays, closed off by a tombstone version
+        return withTransaction(async (db) => {
+          await run(db, INSERT_TOMBSTONE, [params.id]);
+          const result = await run(db, "DELETE FROM passwords WHERE id = ?", [params.id]);
+          
+          if (result.changes === 0) {
+            throw new Error("Password not found");
+          }
+          
+          return { success: true };
         }).then(data => ({
           success: true,
           data,
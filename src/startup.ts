@@ -0,0 +1,36 @@
+import { getDb, getWriteDb, prepareStatements, preloadPages } from "./db";
+import { HOT_READS, HOT_WRITES } from "./routes/passwords";
+
+// performance.now() counts from process start, so these are cold-start figures
+export const startupState = {
+  ready: false,
+  warmupMs: null as number | null,
+  firstResponseSentMs: null as number | null,
+};
+
+export async function warmUp(): Promise<void> {
+  const [db, writeDb] = await Promise.all([getDb(), getWriteDb()]);
+  await Promise.all([
+    prepareStatements(db, HOT_READS),
+    prepareStatements(writeDb, HOT_WRITES),
+  ]);
+
+  if (process.env.PRELOAD_PAGES === "true") {
+    await preloadPages(db);
+  }
+
+  startupState.warmupMs = Math.round(performance.now());
+  startupState.ready = true;
+  console.log(`Warm-up finished ${startupState.warmupMs}ms after start`);
+}
+
+// Called from onResponse, which runs once a response has been sent for any
+// request, including 401s and errors
+export function recordFirstResponse() {
+  if (startupState.firstResponseSentMs !== null) {
+    return;
+  }
+
+  startupState.firstResponseSentMs = Math.round(performance.now());
+  console.log(`First response sent ${startupState.firstResponseSentMs}ms after start`);
+}
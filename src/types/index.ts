@@ -5,10 +5,16 @@ export interface Password {
   password: string;
   url?: string;
   notes?: string;
+  tags?: string[];
   created_at?: string;
   updated_at?: string;
 }
 
+export interface PasswordVersion extends Password {
+  version: number;
+  deleted: boolean;
+}
+
 export interface ApiResponse<T> {
   success: boolean;
   data?: T;